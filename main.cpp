@@ -6,6 +6,7 @@
 
 //=====[Librerías]===========
 #include "mbed.h"
+#include <cstring>
 
 //=====[Definición de parámetros de Tiempo y función del tiempo]===========
 /**
@@ -20,26 +21,94 @@
  */
 #define elapsed_t_s(x)    chrono::duration_cast<chrono::seconds>((x).elapsed_time()).count()
 
+/**
+ * @def elapsed_t_ms(x)
+ * @brief Macro para obtener el tiempo transcurrido en milisegundos desde el inicio de un timer.
+ *
+ * @param x El objeto timer del cual se desea obtener el tiempo transcurrido.
+ * @return El tiempo transcurrido en milisegundos como un valor entero.
+ */
+#define elapsed_t_ms(x)   chrono::duration_cast<chrono::milliseconds>((x).elapsed_time()).count()
+
 #define TIME_FOR_OVERTIME 5         ///< Tiempo en segundos para considerar sobretiempo en la comunicación
 #define ALARM_TIME 20               ///< Tiempo en segundos para la alarma de aviso
 
+#define HEARTBEAT_DEADLINE_MS ((TIME_FOR_OVERTIME + 1) * 1000) ///< Tiempo en milisegundos tras el cual handleMonitorState() pasa a PANIC (elapsed_t_s trunca a segundos)
+#define RELAY_PWM_PERIOD_US 50      ///< Período en microsegundos del PWM del relé (20 kHz, fuera del rango audible)
+#define RELAY_PULL_IN_TIME_MS 100   ///< Tiempo en milisegundos de excitación plena de la bobina para cerrar el relé
+#define RELAY_HOLD_DUTY 0.4f        ///< Ciclo de trabajo del PWM para mantener el relé cerrado una vez atraído
+#define RELAY_MAX_REPULSES 1        ///< Re-excitaciones plenas permitidas si el contacto se suelta durante el mantenimiento, antes de quedar en excitación plena
+#define RELAY_CONFIRM_CLOSED_MS 60000 ///< Tiempo en milisegundos de contacto cerrado sin falla que restituye las re-excitaciones y permite volver al mantenimiento
+#define RELAY_SENSE_TIMEOUT_US 15000 ///< Tiempo máximo en microsegundos de desacuerdo entre "relaySense" y el estado pedido antes de declarar falla (cubre el tiempo de operación del relé)
+#define RELAY_FAULT_REPORT_MS 1000  ///< Período en milisegundos de repetición de 'F' mientras persiste la falla del relé
+
+/**
+ * @brief Cantidad de bits necesarios para representar un valor (0 para el valor 0).
+ *
+ * @param value Valor a medir.
+ * @return int Posición del bit más significativo en 1, contando desde 1.
+ */
+constexpr int bitWidth(uint32_t value) { return value ? 1 + bitWidth(value >> 1) : 0; }
+
+#define TX_BUFFER_SIZE 256          ///< Tamaño en bytes de la cola de transmisión serial (potencia de 2)
+#define TX_EVENT_RESERVE 32         ///< Bytes de la cola reservados para acuses y eventos: la respuesta a 'h' no los ocupa
+
+#define HEARTBEAT_HISTOGRAM_BINS (bitWidth(HEARTBEAT_DEADLINE_MS) + 1) ///< Cantidad de intervalos logarítmicos del histograma de margen de latidos: alcanza justo el margen máximo, HEARTBEAT_DEADLINE_MS
+
+//=====[Definición de las entradas del vehículo en el puerto C (activas en bajo)]===========
+#define BUTTON_MASK   (1u << 13)    ///< PC_13 (BUTTON1), botón de PANIC
+#define DOOR_MASK     (1u << 6)     ///< PC_6, sensor de puerta abierta
+#define HOOD_MASK     (1u << 7)     ///< PC_7, sensor de capó abierto
+#define IGNITION_MASK (1u << 8)     ///< PC_8, encendido del vehículo
+#define TILT_MASK     (1u << 9)     ///< PC_9, sensor de inclinación
+#define VEHICLE_INPUTS_MASK (BUTTON_MASK | DOOR_MASK | HOOD_MASK | IGNITION_MASK | TILT_MASK) ///< Todas las entradas del vehículo
+
+static_assert(BUTTON1 == PC_13, "BUTTON_MASK supone que BUTTON1 es PC_13; ajustar las máscaras del puerto para este target");
+
+#define INPUT_SAMPLE_PERIOD_MS 2    ///< Período en milisegundos de muestreo y filtrado de las entradas
+#define DEBOUNCE_MAX_DEPTH 8        ///< Profundidad máxima del filtro antirrebote (contador vertical de 3 bits)
+#define BUTTON_DEBOUNCE_DEPTH 4     ///< Muestras iguales consecutivas para aceptar un cambio del botón de PANIC
+#define DOOR_DEBOUNCE_DEPTH 8       ///< Muestras iguales consecutivas para aceptar un cambio de la puerta
+#define HOOD_DEBOUNCE_DEPTH 8       ///< Muestras iguales consecutivas para aceptar un cambio del capó
+#define IGNITION_DEBOUNCE_DEPTH 8   ///< Muestras iguales consecutivas para aceptar un cambio del encendido
+#define TILT_DEBOUNCE_DEPTH 3       ///< Muestras iguales consecutivas para aceptar un cambio del sensor de inclinación
+
+//=====[Definición de los gestos del botón de PANIC]===========
+#define GESTURE_LONG_PRESS_MS 1500  ///< Duración en milisegundos a partir de la cual una presión es larga ('L'); las menores son cortas ('S')
+#define GESTURE_LONG_PRESS_MAX_MS 8000 ///< Duración en milisegundos de una presión tras la cual el gesto termina aunque el botón siga presionado (sólo aplica mientras el gesto aún puede completar GESTURE_PIN)
+#define GESTURE_GAP_MS 600          ///< Tiempo en milisegundos sin nuevas presiones que da por terminado un gesto
+#define GESTURE_MAX_PRESSES 8       ///< Cantidad máxima de presiones de un gesto; al alcanzarla el gesto termina
+#define GESTURE_PIN "SSLS"          ///< Secuencia de presiones cortas ('S') y largas ('L') que desarma el sistema localmente
+#define GESTURE_PIN_MAX_ATTEMPTS 3  ///< Intentos fallidos de PIN con "isPanicBlock" activo tras los cuales el botón se ignora hasta recibir 'o'
+
 //=====[Declaración e inicialización de objetos globales públicos]=============
-DigitalIn button(BUTTON1, PullUp);  ///< Botón conectado al pin BUTTON1 con resistencia PullUp, correspondiente a la activación de PANIC.
+PortIn vehicleInputs(PortC, VEHICLE_INPUTS_MASK); ///< Entradas del vehículo (botón de PANIC, puerta, capó, encendido, inclinación) leídas en un único acceso al puerto C
 
 DigitalOut led1(LED1);              ///< LED conectado al pin LED1, indicador de alarma 
-DigitalOut relay(D12);              ///< Relé conectado al pin D12, en el sistema este desconectaria o conectaría el motor del auto 
+PwmOut relay(D12);                  ///< Relé conectado al pin D12, en el sistema este desconectaria o conectaría el motor del auto. Se excita con PWM (ver relaySet())
+DigitalIn relaySense(D10, PullDown); ///< Lectura del contacto del relé en el pin D10: 1 si el contacto está cerrado
 DigitalOut buzzer(D11);             ///< Buzzer conectado al pin D11, indicador de alarma 
 
 Timer timer;                        ///< Timer para la temporización general
+Timer relayTimer;                   ///< Timer para medir el tiempo de atracción del relé y cuánto lleva el contacto cerrado
+Timer relaySenseTimer;              ///< Timer para medir cuánto dura un desacuerdo entre "relaySense" y el estado pedido, y luego el período de repetición de 'F'
+Timer inputTimer;                   ///< Timer para el período de muestreo de las entradas
+Timer uptime;                       ///< Timer libre, nunca se reinicia; referencia de tiempo para la sincronización con la unidad principal
 
 static UnbufferedSerial serialComm(PB_10, PB_11); ///< Comunicación serial sin buffer en los pines PB_10 y PB_11 
 
+char txBuffer[TX_BUFFER_SIZE];      ///< Cola circular de bytes pendientes de enviar por "serialComm"
+uint32_t txHead = 0;                ///< Cantidad de bytes encolados desde el arranque (se enmascara con TX_BUFFER_SIZE - 1 para indexar)
+uint32_t txTail = 0;                ///< Cantidad de bytes enviados desde el arranque (se enmascara con TX_BUFFER_SIZE - 1 para indexar)
+
 //=====[Declaración e inicialización de variables globales públicas]===========
 /**
  * @enum States
  * @brief Enumera los posibles estados del sistema.
+ *
+ * Se almacena en un byte (uint8_t) para que el estado ocupe lo mínimo en RAM.
  */
-enum States {
+enum States : uint8_t {
     OFF,        ///< Estado apagado 
     MONITOR,    ///< Estado de monitoreo 
     PANIC       ///< Estado de pánico 
@@ -48,6 +117,44 @@ enum States {
 States currentState = OFF;          ///< Estado actual del sistema 
 
 bool isPanicBlock = false;          ///< Indica si el estado de pánico se ha concretado o si se da prioridad al boton de PANIC
+bool isSilentPanic = false;         ///< Indica que el PANIC en curso es silencioso: sin LED ni buzzer
+
+char gesturePattern[GESTURE_MAX_PRESSES + 1] = ""; ///< Presiones del gesto en curso: 'S' corta, 'L' larga
+int gesturePresses = 0;             ///< Cantidad de presiones del gesto en curso
+bool isGestureHeld = false;         ///< Indica si el botón está presionado dentro de un gesto
+bool isGestureLongPress = false;    ///< Indica si la presión en curso ya se clasificó como larga
+uint32_t gesturePressTime = 0;      ///< Instante en milisegundos ("uptime") del último flanco de presión
+uint32_t gestureReleaseTime = 0;    ///< Instante en milisegundos ("uptime") del último flanco de liberación
+int gesturePinFailures = 0;         ///< Intentos fallidos de PIN con "isPanicBlock" activo desde el último desarme
+bool isGestureLocked = false;       ///< Indica que se agotaron los intentos de PIN: los gestos se ignoran hasta recibir 'o'
+
+uint32_t inputState = VEHICLE_INPUTS_MASK; ///< Estado filtrado de "vehicleInputs"; un bit en 0 indica entrada activa
+
+/**
+ * @brief Contador vertical del filtro antirrebote, un plano de bits por dígito (bit 0 a bit 2).
+ *
+ * El bit i de cada plano forma el contador de 3 bits de la entrada i. Mientras la muestra
+ * difiere de "inputState" el contador se decrementa; al llegar a 0 la entrada cambia.
+ */
+uint32_t debounceCount[3] = {0, 0, 0};
+
+uint32_t debounceReload[3] = {0, 0, 0}; ///< Valor de recarga del contador (profundidad - 1) por entrada, en planos de bits
+
+bool isRelayOn = false;             ///< Estado pedido para el relé (true: activado)
+bool isRelayHolding = false;        ///< Indica si el relé ya pasó la atracción y se mantiene con RELAY_HOLD_DUTY
+int relayRepulses = 0;              ///< Re-excitaciones plenas realizadas desde la última confirmación de contacto cerrado
+bool isRelayFullDrive = false;      ///< Indica que el relé quedó en excitación plena por agotar las re-excitaciones o por falla
+bool isRelaySenseMismatch = false;  ///< Indica si "relaySense" no coincide con el estado pedido para el relé
+bool isRelayFault = false;          ///< Indica falla del relé: el desacuerdo superó RELAY_SENSE_TIMEOUT_US
+
+/**
+ * @brief Histograma del margen con el que llega cada latido 'm' en MONITOR.
+ *
+ * El intervalo 0 cuenta los latidos llegados sin margen; el intervalo k (k >= 1) los llegados
+ * con un margen de [2^(k-1), 2^k) milisegundos antes de HEARTBEAT_DEADLINE_MS. El margen no
+ * puede superar HEARTBEAT_DEADLINE_MS, por lo que el último intervalo es el que lo contiene.
+ */
+uint32_t heartbeatMarginHistogram[HEARTBEAT_HISTOGRAM_BINS] = {0};
 
 //=====[Declaraciones (prototipos) de funciones públicas]=======================
 /**
@@ -57,6 +164,54 @@ bool isPanicBlock = false;          ///< Indica si el estado de pánico se ha co
  */
 void outputsOffSet();
 
+/**
+ * @brief Activa o desactiva el relé.
+ *
+ * Al activarlo aplica excitación plena durante RELAY_PULL_IN_TIME_MS y luego relayUpdate()
+ * la reduce a RELAY_HOLD_DUTY, suficiente para mantener el contacto y con mucho menor consumo
+ * de la bobina. Llamadas repetidas con el mismo valor no tienen efecto.
+ *
+ * @param on true para activar el relé, false para desactivarlo.
+ * @return void
+ */
+void relaySet(bool on);
+
+/**
+ * @brief Aplica excitación plena a la bobina del relé y reinicia el tiempo de atracción.
+ * @param none
+ * @return void
+ */
+void relayPullIn();
+
+/**
+ * @brief Actualiza la excitación del relé activado.
+ *
+ * Terminado el tiempo de atracción pasa a RELAY_HOLD_DUTY. Si durante el mantenimiento
+ * "relaySense" indica que el contacto se soltó, vuelve a excitar el relé a pleno; se permiten
+ * RELAY_MAX_REPULSES re-excitaciones, que se restituyen cada vez que el contacto lleva
+ * RELAY_CONFIRM_CLOSED_MS cerrado. Agotadas, o con "isRelayFault" activo, el relé queda en
+ * excitación plena hasta que el contacto vuelva a estar cerrado RELAY_CONFIRM_CLOSED_MS sin
+ * falla: una lectura de contacto dañada cuesta corriente de bobina, nunca la inmovilización.
+ *
+ * @param none
+ * @return void
+ */
+void relayUpdate();
+
+/**
+ * @brief Verifica que el contacto del relé coincida con el estado pedido.
+ *
+ * Se ejecuta en cada iteración, por lo que muestrea "relaySense" inmediatamente después de
+ * cada cambio del relé. Si el desacuerdo dura más de RELAY_SENSE_TIMEOUT_US (contacto soldado,
+ * bobina o driver dañados) activa "isRelayFault" y envía 'F' por la comunicación serial, y lo
+ * repite cada RELAY_FAULT_REPORT_MS mientras la falla persiste para que la pérdida de un byte no
+ * la oculte. Cuando el contacto vuelve a coincidir borra la falla y envía 'f'.
+ *
+ * @param none
+ * @return void
+ */
+void relayCheck();
+
 /**
  * @brief Maneja el estado de monitoreo.
  * 
@@ -76,19 +231,53 @@ void handleMonitorState();
  * Controla el parpadeo de los LEDs y el sonido del buzzer durante el estado de pánico.
  * Si se excede el tiempo de alarma, activa el LED, desactiva el buzzer y activa el relé.
  * Además, envía una señal serial 'P' si no se ha bloqueado previamente.
+ * Si "isSilentPanic" está activo, el LED y el buzzer permanecen apagados.
  *
  * @param none
  * @return void
  */
 void handlePanicState();
 
+/**
+ * @brief Encola un mensaje para enviarlo por la comunicación serial.
+ *
+ * Toda salida serial pasa por esta cola para que el bucle principal nunca se bloquee
+ * esperando al UART: processSerialTx() la vacía de a un byte por iteración. Los mensajes
+ * se encolan completos o no se encolan, por lo que no se mezclan entre sí.
+ *
+ * @param message Bytes a enviar.
+ * @param length Cantidad de bytes.
+ * @return bool true si se encoló, false si no había lugar en la cola.
+ */
+bool serialSend(const char *message, int length);
+
+/**
+ * @brief Devuelve el espacio libre en la cola de transmisión serial.
+ * @param none
+ * @return int Bytes libres.
+ */
+int serialFree();
+
+/**
+ * @brief Envía por "serialComm" el próximo byte de la cola si el UART puede aceptarlo.
+ *
+ * Escribe como máximo un byte por llamada y sólo si el puerto está listo, por lo que nunca
+ * bloquea el bucle principal.
+ *
+ * @param none
+ * @return void
+ */
+void processSerialTx();
+
 /**
  * @brief Procesa la comunicación serial entrante y gestiona las transiciones de estado.
  * 
  * Lee un carácter de la comunicación serial y realiza las siguientes acciones según el carácter recibido:
- * - 'o': Transiciona al estado OFF y envía 'O' por la comunicación serial.
+ * - 'o': Transiciona al estado OFF y envía 'O' por la comunicación serial. También desbloquea el PIN local (ver processGesture()).
  * - 'm': Si el estado actual es MONITOR, envía 'M' y reinicia el temporizador; de lo contrario, transiciona a MONITOR y realiza lo mismo.
  * - 'p': Transiciona al estado PANIC y envía 'P' por la comunicación serial.
+ * - 'h': Envía el histograma de margen de latidos (ver sendHeartbeatHistogram()), sin cambiar de estado.
+ * - 't': Responde con el tiempo local del controlador (ver sendUptime()), sin cambiar de estado.
  * - Otros caracteres: Si `isPanicBlock` es verdadero, envía 'P' por la comunicación serial.
  * 
  * Esta función maneja las transiciones de estado del sistema y las respuestas esperadas desde la comunicación serial.
@@ -101,26 +290,150 @@ void handlePanicState();
 void processCommunication();
 
 /**
- * @brief Procesa la presión del botón y maneja la transición de estado.
- * 
- * Esta función verifica el estado del botón y realiza las transiciones de estado
- * apropiadas basadas en la presión del botón y el estado actual del sistema.
- * 
- * - Si el botón está presionado (button == false) y "isButtonPressed" es falso y "isPanicBlock" es falso,
- *   establece "isButtonPressed" a verdadero, activa "isPanicBlock", envía 'P' por el puerto serie y
- *   transiciona el estado del sistema a PANIC. 
- * - la variable isPanicBlock en esta funcion actúa para dar prioridad a PANIC sobre otros estados entrantes con excepción de OFF
- * - Si el botón no está presionado (button == true), establece "isButtonPressed" a falso.
- * 
+ * @brief Envía el tiempo local del controlador para la sincronización de reloj.
+ *
+ * Responde a 't' con "T<ms>\n", donde <ms> son los milisegundos transcurridos desde el
+ * arranque según el timer "uptime" (entero decimal sin signo de 32 bits, da la vuelta a los ~49 días).
+ * La unidad principal marca la hora de envío de 't' y de recepción de la respuesta; con varios
+ * intercambios estima el desfase y la deriva relativa entre ambos relojes y ajusta el margen
+ * de los latidos 'm' respecto de TIME_FOR_OVERTIME.
+ * El tiempo se toma al encolar la respuesta; si la cola de transmisión tenía bytes pendientes
+ * el intercambio tarda más y la unidad principal debería descartarlo por su ida y vuelta.
+ *
+ * @param none
+ * @return void
+ */
+void sendUptime();
+
+/**
+ * @brief Registra en el histograma el margen con el que llegó un latido 'm'.
+ *
+ * Se llama en MONITOR antes de reiniciar el temporizador, cuando "timer" mide el tiempo desde
+ * el latido anterior. El margen es HEARTBEAT_DEADLINE_MS menos ese tiempo, de modo que la
+ * escala logarítmica da más resolución a los latidos que casi provocan un PANIC.
+ *
+ * @param none
+ * @return void
+ */
+void recordHeartbeatMargin();
+
+/**
+ * @brief Envía el histograma de margen de latidos por la comunicación serial.
+ *
+ * Responde a 'h' con "H<c0>,<c1>,...\n", los HEARTBEAT_HISTOGRAM_BINS contadores de
+ * heartbeatMarginHistogram en decimal, del intervalo 0 al último. Los contadores no se
+ * reinician al enviarlos.
+ *
+ * La respuesta se encola con serialSend() y sale de a un byte por iteración del bucle, sin
+ * detener el muestreo de entradas, los gestos ni la verificación del relé. Si la cola no tiene
+ * lugar para la respuesta completa más TX_EVENT_RESERVE, la solicitud se descarta y la unidad
+ * principal debe repetirla.
+ *
+ * @param none
+ * @return void
+ */
+void sendHeartbeatHistogram();
+
+/**
+ * @brief Configura la profundidad del filtro antirrebote de un grupo de entradas.
+ *
+ * @param inputs Máscara de las entradas a configurar.
+ * @param depth Muestras iguales consecutivas necesarias para aceptar un cambio; se limita al rango 1 a DEBOUNCE_MAX_DEPTH.
+ * @return void
+ */
+void debounceSetDepth(uint32_t inputs, int depth);
+
+/**
+ * @brief Filtra una muestra de todas las entradas a la vez con el contador vertical.
+ *
+ * Una entrada cambia de estado cuando su muestra difiere de "inputState" durante la cantidad
+ * de muestras configurada con debounceSetDepth(); cualquier muestra igual recarga su contador.
+ * Procesa las 32 entradas posibles con unas pocas operaciones de bits y actualiza "inputState".
+ *
+ * @param sample Muestra cruda del puerto.
+ * @return uint32_t Máscara de las entradas que cambiaron de estado en esta muestra.
+ */
+uint32_t debounceInputs(uint32_t sample);
+
+/**
+ * @brief Muestrea las entradas del vehículo y despacha las que cambiaron.
+ *
+ * Cada INPUT_SAMPLE_PERIOD_MS lee todo el puerto en un único acceso, lo filtra con
+ * debounceInputs() y llama a processInputChange() sólo para las entradas que cambiaron.
+ *
+ * @param none
+ * @return void
+ */
+void processInputs();
+
+/**
+ * @brief Maneja el cambio de una entrada del vehículo.
+ *
+ * Informa el cambio a la unidad principal con un carácter: en mayúscula al activarse y en
+ * minúscula al desactivarse ('D' puerta, 'B' capó, 'I' encendido, 'L' inclinación).
+ * El botón de PANIC no se informa: sus flancos se entregan a processButtonEdge().
+ *
+ * @param input Máscara con el único bit de la entrada que cambió.
+ * @param isActive true si la entrada quedó activa (nivel bajo).
+ * @return void
+ */
+void processInputChange(uint32_t input, bool isActive);
+
+/**
+ * @brief Registra un flanco filtrado del botón de PANIC en el gesto en curso.
+ *
+ * Guarda el instante de cada flanco; al soltar, una presión que no llegó a GESTURE_LONG_PRESS_MS
+ * se agrega al gesto como corta ('S').
+ *
+ * @param isPressed true en el flanco de presión, false en el de liberación.
+ * @param now Instante del flanco en milisegundos según "uptime".
+ * @return void
+ */
+void processButtonEdge(bool isPressed, uint32_t now);
+
+/**
+ * @brief Reconoce los gestos del botón y maneja la transición de estado.
+ *
+ * A partir de los instantes de los flancos clasifica la presión en curso como larga ('L') al
+ * cumplirse GESTURE_LONG_PRESS_MS. El gesto termina en cuanto las presiones reunidas completan
+ * GESTURE_PIN o ya no pueden completarlo; mientras todavía pueden, termina GESTURE_GAP_MS
+ * después de la última liberación, al llegar a GESTURE_MAX_PRESSES o si el botón sigue
+ * presionado GESTURE_LONG_PRESS_MAX_MS. Luego llama a processGesture().
+ *
+ * Latencia: mantener presionado el botón (PANIC silencioso) se reconoce a GESTURE_LONG_PRESS_MS
+ * del inicio de la presión, porque "L" no inicia GESTURE_PIN; una presión corta se reconoce
+ * GESTURE_GAP_MS después de soltarla. Sólo una presión que continúa una entrada de PIN en curso
+ * puede esperar hasta GESTURE_LONG_PRESS_MAX_MS.
+ *
  * @param none
  * @return void
  */
 void processButtonPress();
 
+/**
+ * @brief Ejecuta el evento correspondiente a un gesto terminado.
+ *
+ * - GESTURE_PIN: desarme local; transiciona a OFF, envía 'O' y borra "isPanicBlock", como 'o'.
+ * - Una presión larga ("L"): PANIC silencioso; como PANIC pero sin LED ni buzzer. Mantener
+ *   presionado el botón de PANIC da por lo tanto un PANIC silencioso, donde antes daba uno audible.
+ * - Cualquier otro gesto (incluida una presión corta): PANIC.
+ * - la variable isPanicBlock actúa para dar prioridad a PANIC: con ella activa sólo se atiende el desarme.
+ *   Cada gesto distinto de GESTURE_PIN cuenta como intento fallido y se informa con 'E'; al
+ *   llegar a GESTURE_PIN_MAX_ATTEMPTS se activa "isGestureLocked" y todos los gestos, incluido
+ *   el PIN correcto, se ignoran (informándose con 'E') hasta que la unidad principal envíe 'o'.
+ *   Así el PIN, de pocas combinaciones, no puede probarse por fuerza bruta con el vehículo bloqueado.
+ *
+ * En PANIC, normal o silencioso, activa "isPanicBlock" y envía 'P' por el puerto serie.
+ *
+ * @param pattern Presiones del gesto: 'S' corta, 'L' larga.
+ * @return void
+ */
+void processGesture(const char *pattern);
+
 /**
  * @brief Transiciona el sistema a un nuevo estado.
  * 
- * Esta función actualiza el estado actual del sistema y reinicia el temporizador.
+ * Esta función actualiza el estado actual del sistema, borra "isSilentPanic" y reinicia el temporizador.
  *
  * @param newState El nuevo estado al que se transicionará (OFF, MONITOR o PANIC).
  * @return void
@@ -154,7 +467,21 @@ int main()
     serialComm.baud(9600);  // Configura la velocidad de baudios a 9600
     serialComm.set_blocking(false);  // Configura la comunicación serial como no bloqueante
 
+    vehicleInputs.mode(PullUp);  // Las entradas del vehículo cierran a masa
+    debounceSetDepth(BUTTON_MASK, BUTTON_DEBOUNCE_DEPTH);
+    debounceSetDepth(DOOR_MASK, DOOR_DEBOUNCE_DEPTH);
+    debounceSetDepth(HOOD_MASK, HOOD_DEBOUNCE_DEPTH);
+    debounceSetDepth(IGNITION_MASK, IGNITION_DEBOUNCE_DEPTH);
+    debounceSetDepth(TILT_MASK, TILT_DEBOUNCE_DEPTH);
+    inputTimer.start();
+
+    relay.period_us(RELAY_PWM_PERIOD_US);  // Configura el período del PWM del relé
+    relay = 0.0f;
+
     timer.start();  // Inicia el temporizador
+    relayTimer.start();
+    relaySenseTimer.start();
+    uptime.start(); // Inicia la referencia de tiempo libre
 
     while (true) {
         processStates();  // Llamada a la función que maneja los estados del sistema
@@ -163,6 +490,7 @@ int main()
 
 void processStates() {
     processCommunication();
+    processInputs();
     processButtonPress();
 
     switch (currentState) {
@@ -176,14 +504,109 @@ void processStates() {
             handlePanicState();
             break;
     }
+
+    relayUpdate();
+    relayCheck();
+    processSerialTx();
 }
 
 void outputsOffSet() {
     led1 = 0;
-    relay = 0;
+    relaySet(false);
     buzzer = 0;
 }
 
+void relaySet(bool on) {
+    if (on == isRelayOn) {
+        return;
+    }
+
+    isRelayOn = on;
+    isRelayFullDrive = false;
+    if (on) {
+        relayRepulses = 0;
+        relayPullIn();
+    } else {
+        relay = 0.0f;
+        isRelayHolding = false;
+    }
+}
+
+void relayPullIn() {
+    relay = 1.0f;
+    isRelayHolding = false;
+    relayTimer.reset();
+}
+
+void relayUpdate() {
+    if (!isRelayOn) {
+        return;
+    }
+
+    bool isContactClosed = relaySense == 1;
+
+    if (isRelayFullDrive) {
+        if (!isContactClosed || isRelayFault) {
+            relayTimer.reset();  // Cuenta sólo el tiempo de contacto cerrado sin interrupciones
+        } else if (elapsed_t_ms(relayTimer) >= RELAY_CONFIRM_CLOSED_MS) {
+            isRelayFullDrive = false;
+            relayRepulses = 0;
+            relay = RELAY_HOLD_DUTY;
+            isRelayHolding = true;
+            relayTimer.reset();
+        }
+    } else if (!isRelayHolding) {
+        if (elapsed_t_ms(relayTimer) >= RELAY_PULL_IN_TIME_MS) {
+            if (isRelayFault) {
+                isRelayFullDrive = true;
+                relayTimer.reset();
+            } else {
+                relay = RELAY_HOLD_DUTY;
+                isRelayHolding = true;
+            }
+        }
+    } else if (!isContactClosed) {
+        if (isRelayFault || relayRepulses >= RELAY_MAX_REPULSES) {
+            relay = 1.0f;
+            isRelayHolding = false;
+            isRelayFullDrive = true;
+            relayTimer.reset();
+        } else {
+            relayRepulses++;
+            relayPullIn();  // El contacto se soltó con la excitación reducida
+        }
+    } else if (relayRepulses > 0 && elapsed_t_ms(relayTimer) >= RELAY_CONFIRM_CLOSED_MS) {
+        relayRepulses = 0;  // En mantenimiento el contacto estuvo cerrado desde la última re-excitación
+    }
+}
+
+void relayCheck() {
+    bool isContactClosed = relaySense == 1;
+
+    if (isContactClosed == isRelayOn) {
+        if (isRelayFault) {
+            serialSend("f", 1);
+        }
+        isRelaySenseMismatch = false;
+        isRelayFault = false;
+        return;
+    }
+
+    if (!isRelaySenseMismatch) {
+        isRelaySenseMismatch = true;
+        relaySenseTimer.reset();
+    } else if (!isRelayFault) {
+        if (relaySenseTimer.elapsed_time() > chrono::microseconds(RELAY_SENSE_TIMEOUT_US)) {
+            isRelayFault = true;
+            serialSend("F", 1);
+            relaySenseTimer.reset();
+        }
+    } else if (elapsed_t_ms(relaySenseTimer) >= RELAY_FAULT_REPORT_MS) {
+        serialSend("F", 1);
+        relaySenseTimer.reset();
+    }
+}
+
 void handleMonitorState() {
     outputsOffSet();
 
@@ -195,19 +618,41 @@ void handleMonitorState() {
 void handlePanicState() {
     int elapsed = elapsed_t_s(timer);
     if (elapsed < ALARM_TIME) {
-        led1 = elapsed % 2;
-        buzzer = elapsed % 2;
+        led1 = isSilentPanic ? 0 : elapsed % 2;
+        buzzer = isSilentPanic ? 0 : elapsed % 2;
     } else {
-        led1 = 1;
+        led1 = isSilentPanic ? 0 : 1;
         buzzer = 0;
-        relay = 1;
+        relaySet(true);
         if (!isPanicBlock) {
-            serialComm.write("P", 1);
+            serialSend("P", 1);
             isPanicBlock = true;
         }
     }
 }
 
+bool serialSend(const char *message, int length) {
+    if (length > serialFree()) {
+        return false;
+    }
+
+    for (int i = 0; i < length; i++) {
+        txBuffer[txHead++ & (TX_BUFFER_SIZE - 1)] = message[i];
+    }
+    return true;
+}
+
+int serialFree() {
+    return TX_BUFFER_SIZE - (int)(txHead - txTail);
+}
+
+void processSerialTx() {
+    if (txTail != txHead && serialComm.writable()) {
+        serialComm.write(&txBuffer[txTail & (TX_BUFFER_SIZE - 1)], 1);
+        txTail++;
+    }
+}
+
 void processCommunication() {
     if (serialComm.readable()) {
         char ch;
@@ -216,48 +661,223 @@ void processCommunication() {
                 switch (ch) {
                     case 'o':
                         transitionToState(OFF);
-                        serialComm.write("O", 1);
+                        serialSend("O", 1);
                         isPanicBlock = false;
+                        isGestureLocked = false;
+                        gesturePinFailures = 0;
                         break;
                     case 'm':
                         if (currentState == MONITOR) {
-                            serialComm.write("M", 1);
+                            recordHeartbeatMargin();
+                            serialSend("M", 1);
                             timer.reset();
                         } else {
                             transitionToState(MONITOR);
-                            serialComm.write("M", 1);
+                            serialSend("M", 1);
                             timer.reset();
                         }
                         break;
                     case 'p':
                         transitionToState(PANIC);
-                        serialComm.write("P", 1);
+                        serialSend("P", 1);
+                        break;
+                    case 'h':
+                        sendHeartbeatHistogram();
+                        break;
+                    case 't':
+                        sendUptime();
                         break;
                     default:
                         break;
                 }
             } else {
-                serialComm.write("P", 1);
+                serialSend("P", 1);
             }
         }
     }
 }
 
+void sendUptime() {
+    char message[16];
+    int length = snprintf(message, sizeof(message), "T%lu\n", (unsigned long)(uint32_t)elapsed_t_ms(uptime));
+    serialSend(message, length);
+}
+
+void recordHeartbeatMargin() {
+    long long margin = HEARTBEAT_DEADLINE_MS - elapsed_t_ms(timer);
+    int bin = 0;
+
+    if (margin > 0) {
+        bin = 32 - __builtin_clz((uint32_t)margin);  // Posición del bit más significativo, a lo sumo bitWidth(HEARTBEAT_DEADLINE_MS)
+    }
+    heartbeatMarginHistogram[bin]++;
+}
+
+void sendHeartbeatHistogram() {
+    char message[HEARTBEAT_HISTOGRAM_BINS * 11 + 2];  // 'H', hasta 10 dígitos y separador por intervalo
+    int length = snprintf(message, sizeof(message), "H");
+
+    for (int i = 0; i < HEARTBEAT_HISTOGRAM_BINS; i++) {
+        length += snprintf(message + length, sizeof(message) - length, i == 0 ? "%lu" : ",%lu",
+                           (unsigned long)heartbeatMarginHistogram[i]);
+    }
+    message[length++] = '\n';
+    if (length + TX_EVENT_RESERVE <= serialFree()) {
+        serialSend(message, length);
+    }
+}
+
+void debounceSetDepth(uint32_t inputs, int depth) {
+    if (depth < 1) {
+        depth = 1;
+    } else if (depth > DEBOUNCE_MAX_DEPTH) {
+        depth = DEBOUNCE_MAX_DEPTH;
+    }
+
+    uint32_t reload = (uint32_t)(depth - 1);
+
+    for (int i = 0; i < 3; i++) {
+        if (reload & (1u << i)) {
+            debounceReload[i] |= inputs;
+        } else {
+            debounceReload[i] &= ~inputs;
+        }
+        debounceCount[i] = (debounceCount[i] & ~inputs) | (debounceReload[i] & inputs);
+    }
+}
+
+uint32_t debounceInputs(uint32_t sample) {
+    uint32_t delta = sample ^ inputState;
+    uint32_t toggle = delta & ~(debounceCount[0] | debounceCount[1] | debounceCount[2]);
+    uint32_t reload = ~delta | toggle;
+
+    // Decremento de todos los contadores a la vez: cada bit se invierte si los inferiores eran 0
+    uint32_t count2 = debounceCount[2] ^ (~debounceCount[0] & ~debounceCount[1]);
+    uint32_t count1 = debounceCount[1] ^ ~debounceCount[0];
+    uint32_t count0 = ~debounceCount[0];
+
+    debounceCount[0] = (count0 & ~reload) | (debounceReload[0] & reload);
+    debounceCount[1] = (count1 & ~reload) | (debounceReload[1] & reload);
+    debounceCount[2] = (count2 & ~reload) | (debounceReload[2] & reload);
+
+    inputState ^= toggle;
+    return toggle;
+}
+
+void processInputs() {
+    if (elapsed_t_ms(inputTimer) < INPUT_SAMPLE_PERIOD_MS) {
+        return;
+    }
+    inputTimer.reset();
+
+    uint32_t changed = debounceInputs(vehicleInputs.read());
+
+    while (changed) {
+        uint32_t input = changed & (~changed + 1);  // Bit menos significativo en 1
+        changed &= changed - 1;
+        processInputChange(input, (inputState & input) == 0);
+    }
+}
+
+void processInputChange(uint32_t input, bool isActive) {
+    char code;
+
+    switch (input) {
+        case BUTTON_MASK:
+            processButtonEdge(isActive, (uint32_t)elapsed_t_ms(uptime));
+            return;
+        case DOOR_MASK:
+            code = 'D';
+            break;
+        case HOOD_MASK:
+            code = 'B';
+            break;
+        case IGNITION_MASK:
+            code = 'I';
+            break;
+        case TILT_MASK:
+            code = 'L';
+            break;
+        default:
+            return;
+    }
+
+    if (!isActive) {
+        code = code - 'A' + 'a';
+    }
+    serialSend(&code, 1);
+}
+
+void processButtonEdge(bool isPressed, uint32_t now) {
+    if (isPressed) {
+        isGestureHeld = true;
+        isGestureLongPress = false;
+        gesturePressTime = now;
+    } else if (isGestureHeld) {
+        isGestureHeld = false;
+        gestureReleaseTime = now;
+        if (!isGestureLongPress) {
+            gesturePattern[gesturePresses++] = 'S';
+        }
+    }
+}
+
 void processButtonPress() {
+    uint32_t now = (uint32_t)elapsed_t_ms(uptime);
+    bool isGestureDone = false;
+
+    if (isGestureHeld) {
+        uint32_t held = now - gesturePressTime;
+        if (!isGestureLongPress && held >= GESTURE_LONG_PRESS_MS) {
+            isGestureLongPress = true;
+            gesturePattern[gesturePresses++] = 'L';
+        }
+        isGestureDone = held >= GESTURE_LONG_PRESS_MAX_MS;
+    } else if (gesturePresses > 0) {
+        isGestureDone = now - gestureReleaseTime >= GESTURE_GAP_MS;
+    }
+
+    if (gesturePresses == GESTURE_MAX_PRESSES) {
+        isGestureDone = true;
+    }
 
-    bool isButtonPressed = false;  // Variable local para la presión del botón
+    // Termina sin esperar si el patrón ya completó GESTURE_PIN o ya no puede completarlo
+    if (gesturePresses > 0 && (strncmp(gesturePattern, GESTURE_PIN, gesturePresses) != 0 ||
+                               gesturePresses == (int)strlen(GESTURE_PIN))) {
+        isGestureDone = true;
+    }
 
-    if (button == 0 && !isButtonPressed && !isPanicBlock) {
-        isButtonPressed = true;
+    if (isGestureDone) {
+        gesturePattern[gesturePresses] = '\0';
+        processGesture(gesturePattern);
+        gesturePresses = 0;
+        isGestureHeld = false;  // Si sigue presionado, su liberación no inicia otro gesto
+    }
+}
+
+void processGesture(const char *pattern) {
+    if (isGestureLocked) {
+        serialSend("E", 1);
+    } else if (strcmp(pattern, GESTURE_PIN) == 0) {
+        transitionToState(OFF);
+        serialSend("O", 1);
+        isPanicBlock = false;
+        gesturePinFailures = 0;
+    } else if (isPanicBlock) {
+        serialSend("E", 1);
+        if (++gesturePinFailures >= GESTURE_PIN_MAX_ATTEMPTS) {
+            isGestureLocked = true;
+        }
+    } else {
         isPanicBlock = true;
-        serialComm.write("P", 1);
+        serialSend("P", 1);
         transitionToState(PANIC);
-    } else if (button == 1) {
-        isButtonPressed = false;
+        isSilentPanic = strcmp(pattern, "L") == 0;
     }
 }
 
 void transitionToState(States newState) {
     currentState = newState;
+    isSilentPanic = false;
     timer.reset();
 }
@@ -0,0 +1,370 @@
+/**
+ * @file controller_test.cpp
+ * @brief Escenarios de prueba de la lógica del controlador sobre el modelo de host (ver mbed.h).
+ *
+ * Incluye main.cpp renombrando su función main() y ejecuta processStates() con el tiempo
+ * simulado avanzando 100 us por iteración.
+ */
+
+#define main controllerMain
+#include "../../main.cpp"
+#undef main
+
+HostModel host;
+
+//=====[Utilidades de prueba]===========
+static int failures = 0;    ///< Cantidad de verificaciones fallidas
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("%s:%d: falló CHECK(%s)\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+static int relayStuck = -1; ///< -1: el contacto sigue a la bobina; 0 o 1: contacto trabado en ese nivel
+
+/**
+ * @brief Inicializa el controlador como lo hace main().
+ */
+static void setup() {
+    debounceSetDepth(BUTTON_MASK, BUTTON_DEBOUNCE_DEPTH);
+    debounceSetDepth(DOOR_MASK, DOOR_DEBOUNCE_DEPTH);
+    debounceSetDepth(HOOD_MASK, HOOD_DEBOUNCE_DEPTH);
+    debounceSetDepth(IGNITION_MASK, IGNITION_DEBOUNCE_DEPTH);
+    debounceSetDepth(TILT_MASK, TILT_DEBOUNCE_DEPTH);
+    inputTimer.start();
+    timer.start();
+    relayTimer.start();
+    relaySenseTimer.start();
+    uptime.start();
+}
+
+/**
+ * @brief Avanza el tiempo simulado ejecutando el bucle principal.
+ *
+ * El contacto del relé cierra mientras la bobina está excitada, salvo que "relayStuck" lo trabe.
+ *
+ * @param ms Milisegundos a simular.
+ */
+static void step(long long ms) {
+    for (long long i = 0; i < ms * 10; i++) {
+        host.nowUs += 100;
+        host.relaySense = relayStuck >= 0 ? relayStuck : host.relayDuty > 0.0f;
+        processStates();
+    }
+}
+
+/**
+ * @brief Vuelve al estado OFF con el relé sano y la salida serial vacía.
+ */
+static void reset() {
+    relayStuck = -1;
+    host.rx.push_back('o');
+    step(100);
+    host.tx.clear();
+}
+
+/**
+ * @brief Cuenta las apariciones de un carácter en lo enviado por la comunicación serial.
+ */
+static int sent(char ch) {
+    int count = 0;
+    for (char c : host.tx) {
+        count += c == ch;
+    }
+    return count;
+}
+
+//=====[Escenarios de falla del relé]===========
+/**
+ * @brief Contacto soldado: el relé está apagado pero el contacto sigue cerrado.
+ */
+static void testRelayWeldedClosed() {
+    reset();
+    relayStuck = 1;
+    step(10);
+    CHECK(!isRelayFault);
+    step(10);
+    CHECK(isRelayFault);
+    CHECK(host.tx == "F");
+
+    step(3500);
+    CHECK(sent('F') == 4);
+
+    relayStuck = -1;
+    step(10);
+    CHECK(!isRelayFault);
+    CHECK(host.tx.back() == 'f');
+}
+
+/**
+ * @brief Contacto abierto: el relé se activa en PANIC pero el contacto no cierra.
+ */
+static void testRelayStuckOpen() {
+    reset();
+    host.rx.push_back('p');
+    step(ALARM_TIME * 1000 - 100);
+    CHECK(!isRelayOn);
+    relayStuck = 0;
+    step(100 + 20);
+    CHECK(isRelayOn);
+    CHECK(isRelayFault);
+    CHECK(sent('F') == 1);
+
+    step(2000);
+    CHECK(sent('F') == 3);
+    CHECK(sent('f') == 0);
+
+    relayStuck = -1;
+    step(10);
+    CHECK(!isRelayFault);
+    CHECK(host.tx.back() == 'f');
+}
+
+//=====[Escenarios de excitación del relé]===========
+/**
+ * @brief Lleva el controlador a PANIC hasta que el relé queda en mantenimiento.
+ */
+static void engageRelay() {
+    reset();
+    host.rx.push_back('p');
+    step(ALARM_TIME * 1000 + RELAY_PULL_IN_TIME_MS + 100);
+    CHECK(isRelayOn);
+    CHECK(host.relayDuty == RELAY_HOLD_DUTY);
+}
+
+/**
+ * @brief Simula que el contacto se suelta brevemente (menos que RELAY_SENSE_TIMEOUT_US).
+ */
+static void dropout() {
+    relayStuck = 0;
+    step(5);
+    relayStuck = -1;
+    step(RELAY_PULL_IN_TIME_MS + 100);
+}
+
+/**
+ * @brief Caídas del contacto separadas por mucho tiempo se re-excitan siempre.
+ */
+static void testRelayDropoutsHoursApart() {
+    engageRelay();
+    dropout();
+    CHECK(host.relayDuty == RELAY_HOLD_DUTY);
+    CHECK(relayRepulses == 1);
+
+    step(3600L * 1000);
+    CHECK(relayRepulses == 0);
+    dropout();
+    CHECK(host.relayDuty == RELAY_HOLD_DUTY);
+    CHECK(host.relaySense == 1);
+    CHECK(!isRelayFault);
+}
+
+/**
+ * @brief Caídas seguidas agotan las re-excitaciones: excitación plena hasta confirmar el contacto.
+ */
+static void testRelayRepeatedDropouts() {
+    engageRelay();
+    dropout();
+    dropout();
+    CHECK(isRelayFullDrive);
+    CHECK(host.relayDuty == 1.0f);
+    CHECK(host.relaySense == 1);
+
+    step(RELAY_CONFIRM_CLOSED_MS + 10);
+    CHECK(!isRelayFullDrive);
+    CHECK(host.relayDuty == RELAY_HOLD_DUTY);
+}
+
+/**
+ * @brief Lectura de contacto dañada: el relé queda en excitación plena, sin oscilar.
+ */
+static void testRelayBrokenSense() {
+    reset();
+    host.rx.push_back('p');
+    step(ALARM_TIME * 1000 - 100);
+    relayStuck = 0;
+    host.relayDutyChanges = 0;
+    step(10000);
+    CHECK(isRelayFault);
+    CHECK(host.relayDuty == 1.0f);
+    CHECK(host.relayDutyChanges == 1);
+}
+
+//=====[Escenarios de gestos del botón de PANIC]===========
+/**
+ * @brief Mantiene presionado el botón de PANIC durante el tiempo indicado y lo suelta.
+ */
+static void press(long long ms) {
+    host.port &= ~BUTTON_MASK;
+    step(ms);
+    host.port |= BUTTON_MASK;
+}
+
+/**
+ * @brief Avanza de a 1 ms hasta que se envía el carácter indicado.
+ *
+ * @return long long Milisegundos transcurridos, o -1 si no se envió dentro del límite.
+ */
+static long long msUntilSent(char ch, long long limitMs) {
+    for (long long ms = 0; ms <= limitMs; ms++) {
+        if (host.tx.find(ch) != string::npos) {
+            return ms;
+        }
+        step(1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Ingresa GESTURE_PIN, con presiones largas de la duración indicada.
+ */
+static void enterPin(long long longPressMs) {
+    for (const char *symbol = GESTURE_PIN; *symbol; symbol++) {
+        press(*symbol == 'L' ? longPressMs : 100);
+        step(200);
+    }
+}
+
+/**
+ * @brief Mantener presionado el botón da PANIC silencioso a GESTURE_LONG_PRESS_MS.
+ */
+static void testGestureHoldLatency() {
+    reset();
+    host.port &= ~BUTTON_MASK;
+    long long latency = msUntilSent('P', GESTURE_LONG_PRESS_MAX_MS);
+    host.port |= BUTTON_MASK;
+    step(100);
+    CHECK(latency >= GESTURE_LONG_PRESS_MS);
+    CHECK(latency <= GESTURE_LONG_PRESS_MS + 20);
+    CHECK(currentState == PANIC);
+    CHECK(isSilentPanic);
+}
+
+/**
+ * @brief Una presión corta da PANIC audible GESTURE_GAP_MS después de soltarla.
+ */
+static void testGestureTap() {
+    reset();
+    press(100);
+    long long latency = msUntilSent('P', 2000);
+    CHECK(latency >= GESTURE_GAP_MS);
+    CHECK(latency <= GESTURE_GAP_MS + 20);
+    CHECK(currentState == PANIC);
+    CHECK(!isSilentPanic);
+}
+
+/**
+ * @brief El PIN desarma aunque su presión larga dure varios segundos.
+ */
+static void testGesturePinDisarm() {
+    reset();
+    press(100);
+    step(GESTURE_GAP_MS + 100);
+    CHECK(isPanicBlock);
+    host.tx.clear();
+    enterPin(3500);
+    CHECK(currentState == OFF);
+    CHECK(!isPanicBlock);
+    CHECK(host.tx == "O");
+}
+
+/**
+ * @brief Con el vehículo bloqueado, tras GESTURE_PIN_MAX_ATTEMPTS fallos el PIN se rechaza hasta 'o'.
+ */
+static void testGesturePinLockout() {
+    reset();
+    press(100);
+    step(GESTURE_GAP_MS + 100);
+    CHECK(isPanicBlock);
+    host.tx.clear();
+
+    for (int i = 0; i < GESTURE_PIN_MAX_ATTEMPTS; i++) {
+        press(2000);
+        step(100);
+    }
+    CHECK(isGestureLocked);
+    enterPin(2000);
+    CHECK(currentState == PANIC);
+    CHECK(isPanicBlock);
+    CHECK(sent('E') == GESTURE_PIN_MAX_ATTEMPTS + 1);
+
+    host.rx.push_back('o');
+    step(10);
+    CHECK(!isGestureLocked);
+}
+
+//=====[Escenarios de la comunicación serial]===========
+/**
+ * @brief La respuesta a 'h' sale de a un byte por iteración y no demora los comandos siguientes.
+ */
+static void testHistogramReplyDoesNotStall() {
+    reset();
+    for (int i = 0; i < HEARTBEAT_HISTOGRAM_BINS; i++) {
+        heartbeatMarginHistogram[i] = 4000000000u;  // Respuesta de longitud máxima
+    }
+    host.rx.push_back('h');
+    step(1);
+    CHECK(host.tx.size() <= 10);
+    host.rx.push_back('m');
+    step(1);
+    CHECK(currentState == MONITOR);
+
+    for (int i = 0; i < 2000; i++) {
+        size_t before = host.tx.size();
+        host.nowUs += 100;
+        processStates();
+        CHECK(host.tx.size() - before <= 1);
+    }
+    string reply = host.tx.substr(0, host.tx.find('\n') + 1);
+    CHECK(reply.size() == (size_t)(1 + HEARTBEAT_HISTOGRAM_BINS * 11));
+    CHECK(reply.compare(0, 11, "H4000000000") == 0);
+    CHECK(host.tx.substr(reply.size()) == "M");
+
+    for (int i = 0; i < HEARTBEAT_HISTOGRAM_BINS; i++) {
+        heartbeatMarginHistogram[i] = 0;
+    }
+}
+
+/**
+ * @brief Pedidos de 'h' repetidos no dejan sin lugar a los acuses.
+ */
+static void testHistogramFloodKeepsAcks() {
+    reset();
+    for (int i = 0; i < HEARTBEAT_HISTOGRAM_BINS; i++) {
+        heartbeatMarginHistogram[i] = 4000000000u;
+    }
+    for (int i = 0; i < 4; i++) {
+        host.rx.push_back('h');
+    }
+    host.rx.push_back('p');
+    step(200);
+    CHECK(currentState == PANIC);
+    CHECK(sent('\n') == 1);
+    CHECK(host.tx.back() == 'P');
+
+    for (int i = 0; i < HEARTBEAT_HISTOGRAM_BINS; i++) {
+        heartbeatMarginHistogram[i] = 0;
+    }
+}
+
+int main() {
+    setup();
+
+    testRelayWeldedClosed();
+    testRelayStuckOpen();
+    testRelayDropoutsHoursApart();
+    testRelayRepeatedDropouts();
+    testRelayBrokenSense();
+    testGestureHoldLatency();
+    testGestureTap();
+    testGesturePinDisarm();
+    testGesturePinLockout();
+    testHistogramReplyDoesNotStall();
+    testHistogramFloodKeepsAcks();
+
+    printf("%s\n", failures == 0 ? "OK" : "FALLÓ");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file mbed.h
+ * @brief Modelo de host de la API de mbed usada por main.cpp, para probar la lógica del controlador en la PC.
+ *
+ * Reemplaza a "mbed.h" al compilar main.cpp fuera del microcontrolador. El tiempo, el puerto de
+ * entradas, la lectura del contacto del relé y la comunicación serial se controlan desde la
+ * variable global "host"; las salidas se registran en ella para que las pruebas las verifiquen.
+ */
+
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <sys/types.h>
+
+//=====[Pines y puertos usados por main.cpp]===========
+enum PinName { PC_13, BUTTON1 = PC_13, LED1, D10, D11, D12, PB_10, PB_11 };
+enum PortName { PortA, PortB, PortC };
+enum PinMode { PullNone, PullUp, PullDown };
+
+//=====[Estado del modelo de host]===========
+/**
+ * @brief Estado del hardware simulado, manejado por las pruebas.
+ */
+struct HostModel {
+    long long nowUs = 0;                ///< Tiempo simulado en microsegundos
+    uint32_t port = 0xFFFFFFFF;         ///< Nivel de los pines del puerto de entradas (activas en bajo)
+    int relaySense = 0;                 ///< Nivel leído en la entrada de contacto del relé
+    float relayDuty = 0.0f;             ///< Último ciclo de trabajo escrito en el PWM del relé
+    int relayDutyChanges = 0;           ///< Cantidad de cambios del ciclo de trabajo del relé
+    std::deque<char> rx;                ///< Bytes pendientes de recibir por la comunicación serial
+    std::string tx;                     ///< Bytes enviados por la comunicación serial
+};
+
+extern HostModel host;
+
+namespace mbed {
+
+class DigitalIn {
+public:
+    DigitalIn(PinName, PinMode = PullNone) {}
+    int read() { return host.relaySense; }
+    operator int() { return read(); }
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName, int value = 0) : _value(value) {}
+    void write(int value) { _value = value; }
+    int read() { return _value; }
+    DigitalOut &operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+private:
+    int _value;
+};
+
+class PwmOut {
+public:
+    PwmOut(PinName) {}
+    void period_us(int) {}
+    void write(float duty) {
+        if (duty != host.relayDuty) {
+            host.relayDuty = duty;
+            host.relayDutyChanges++;
+        }
+    }
+    float read() { return host.relayDuty; }
+    PwmOut &operator=(float duty) { write(duty); return *this; }
+    operator float() { return read(); }
+};
+
+class PortIn {
+public:
+    PortIn(PortName, int mask = 0xFFFFFFFF) : _mask(mask) {}
+    void mode(PinMode) {}
+    int read() { return host.port & _mask; }
+    operator int() { return read(); }
+private:
+    uint32_t _mask;
+};
+
+class Timer {
+public:
+    void start() {
+        if (!_running) {
+            _running = true;
+            _start = host.nowUs - _elapsed;
+        }
+    }
+    void stop() {
+        _elapsed = elapsed_time().count();
+        _running = false;
+    }
+    void reset() {
+        _elapsed = 0;
+        _start = host.nowUs;
+    }
+    std::chrono::microseconds elapsed_time() {
+        return std::chrono::microseconds(_running ? host.nowUs - _start : _elapsed);
+    }
+private:
+    bool _running = false;
+    long long _start = 0;
+    long long _elapsed = 0;
+};
+
+class UnbufferedSerial {
+public:
+    UnbufferedSerial(PinName, PinName, int = 9600) {}
+    void baud(int) {}
+    int set_blocking(bool) { return 0; }
+    bool readable() { return !host.rx.empty(); }
+    bool writable() { return true; }
+    ssize_t read(void *buffer, size_t length) {
+        if (length == 0 || host.rx.empty()) {
+            return 0;
+        }
+        *static_cast<char *>(buffer) = host.rx.front();
+        host.rx.pop_front();
+        return 1;
+    }
+    ssize_t write(const void *buffer, size_t length) {
+        host.tx.append(static_cast<const char *>(buffer), length);
+        return length;
+    }
+};
+
+} // namespace mbed
+
+using namespace mbed;
+using namespace std;
+
+#endif // HOST_MBED_H